@@ -1,49 +1,95 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 #include <openssl/sha.h>
 
 using namespace std;
 
-// Function to compute SHA256 hash of a string
-string computeSHA256(const string& data) {
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256((unsigned char*)data.c_str(), data.size(), hash);
+// Fixed-size binary SHA256 digest (hex is only produced for printing)
+struct Hash256 {
+    array<uint8_t, SHA256_DIGEST_LENGTH> bytes{};
 
-    char hexStr[2 * SHA256_DIGEST_LENGTH + 1];
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-        sprintf(hexStr + (i * 2), "%02x", hash[i]);
+    bool operator==(const Hash256& other) const {
+        return memcmp(bytes.data(), other.bytes.data(), bytes.size()) == 0;
     }
-    hexStr[2 * SHA256_DIGEST_LENGTH] = 0;
+    bool operator!=(const Hash256& other) const { return !(*this == other); }
+    bool operator<(const Hash256& other) const {
+        return memcmp(bytes.data(), other.bytes.data(), bytes.size()) < 0;
+    }
+
+    string toHex() const {
+        static const char digits[] = "0123456789abcdef";
+        string hexStr(2 * bytes.size(), '0');
+        for (size_t i = 0; i < bytes.size(); i++) {
+            hexStr[2 * i] = digits[bytes[i] >> 4];
+            hexStr[2 * i + 1] = digits[bytes[i] & 0x0f];
+        }
+        return hexStr;
+    }
+};
+static_assert(is_trivially_copyable<Hash256>::value, "Hash256 must stay trivially copyable");
 
-    return string(hexStr);
+ostream& operator<<(ostream& os, const Hash256& h) {
+    return os << h.toHex();
+}
+
+// Function to compute SHA256 hash of a buffer
+Hash256 computeSHA256(const void* data, size_t len) {
+    Hash256 hash;
+    SHA256(static_cast<const unsigned char*>(data), len, hash.bytes.data());
+    return hash;
+}
+
+Hash256 computeSHA256(const string& data) {
+    return computeSHA256(data.data(), data.size());
+}
+
+// Hash of two child digests concatenated (64 raw bytes)
+Hash256 hashPair(const Hash256& left, const Hash256& right) {
+    unsigned char combined[2 * SHA256_DIGEST_LENGTH];
+    memcpy(combined, left.bytes.data(), SHA256_DIGEST_LENGTH);
+    memcpy(combined + SHA256_DIGEST_LENGTH, right.bytes.data(), SHA256_DIGEST_LENGTH);
+    return computeSHA256(combined, sizeof(combined));
 }
 
 // Class representing a Merkle Tree
 class MerkleTree {
 private:
     vector<string> leaves;
-    vector<string> tree;
+    vector<Hash256> tree;         // All levels stored back to back, leaves first
+    vector<size_t> levelOffsets;  // Start of each level in `tree` (plus a final end marker)
 
     // Build the Merkle Tree
     void buildTree() {
-        tree.clear();
-        for (const auto& leaf : leaves) {
-            tree.push_back(computeSHA256(leaf));
+        // Level sizes are known up front, so the whole tree is allocated once
+        levelOffsets.assign(1, 0);
+        size_t levelSize = leaves.size();
+        while (levelSize > 0) {
+            levelOffsets.push_back(levelOffsets.back() + levelSize);
+            if (levelSize == 1) {
+                break;
+            }
+            levelSize = (levelSize + 1) / 2;
         }
+        tree.assign(levelOffsets.back(), Hash256{});
 
-        int offset = 0;
-        while (tree.size() - offset > 1) {
-            int levelSize = tree.size() - offset;
-            for (int i = 0; i < levelSize; i += 2) {
-                if (i + 1 < levelSize) {
-                    string combined = tree[offset + i] + tree[offset + i + 1];
-                    tree.push_back(computeSHA256(combined));
+        for (size_t i = 0; i < leaves.size(); i++) {
+            tree[i] = computeSHA256(leaves[i]);
+        }
+        for (size_t level = 0; level + 1 < levelCount(); level++) {
+            size_t size = levelWidth(level);
+            Hash256* parents = &tree[levelOffsets[level + 1]];
+            for (size_t i = 0; i < size; i += 2) {
+                if (i + 1 < size) {
+                    parents[i / 2] = hashPair(node(level, i), node(level, i + 1));
                 } else {
-                    tree.push_back(tree[offset + i]); // Handle odd number of nodes
+                    parents[i / 2] = node(level, i); // Handle odd number of nodes
                 }
             }
-            offset += levelSize;
         }
     }
 
@@ -52,20 +98,31 @@ public:
         buildTree();
     }
 
+    // Number of levels, leaves (level 0) up to the root
+    size_t levelCount() const {
+        return levelOffsets.size() - 1;
+    }
+
+    size_t levelWidth(size_t level) const {
+        return levelOffsets[level + 1] - levelOffsets[level];
+    }
+
+    // Node `index` of `level`, in O(1)
+    const Hash256& node(size_t level, size_t index) const {
+        return tree[levelOffsets[level] + index];
+    }
+
     // Get the root of the Merkle Tree
-    string getRoot() const {
-        return tree.empty() ? "" : tree.back();
+    Hash256 getRoot() const {
+        return tree.empty() ? Hash256{} : tree.back();
     }
 
-    // Print the Merkle Tree
+    // Print the Merkle Tree, root first
     void printTree() const {
-        int level = 0;
-        int count = 1;
-        for (size_t i = 0; i < tree.size(); i++) {
-            cout << "Level " << level << ": " << tree[i] << endl;
-            if (--count == 0) {
-                level++;
-                count = 1 << level;
+        for (size_t depth = 0; depth < levelCount(); depth++) {
+            size_t level = levelCount() - 1 - depth;
+            for (size_t i = 0; i < levelWidth(level); i++) {
+                cout << "Level " << depth << ": " << node(level, i) << endl;
             }
         }
     }
@@ -1,50 +1,137 @@
 #include <iostream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <chrono>
 #include <iomanip>
 #include <cstdint>
+#include <cstring>
+#include <array>
+#include <type_traits>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <algorithm>
 #include <openssl/sha.h>
 
-// === Helper function: compute SHA256 and return hex string ===
-std::string sha256_hex(const std::string& data) {
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), hash);
-    std::ostringstream oss;
-    oss << std::hex << std::setfill('0');
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i)
-        oss << std::setw(2) << static_cast<int>(hash[i]);
-    return oss.str();
+// === Hash256: fixed-size binary SHA256 digest ===
+// Hashes stay as raw 32-byte values; hex is only produced when printing.
+struct Hash256 {
+    std::array<uint8_t, SHA256_DIGEST_LENGTH> bytes{};
+
+    bool operator==(const Hash256& other) const {
+        return std::memcmp(bytes.data(), other.bytes.data(), bytes.size()) == 0;
+    }
+    bool operator!=(const Hash256& other) const { return !(*this == other); }
+    bool operator<(const Hash256& other) const {
+        return std::memcmp(bytes.data(), other.bytes.data(), bytes.size()) < 0;
+    }
+
+    // True if the hex form starts with `count` '0' characters
+    bool hasLeadingZeroNibbles(uint32_t count) const {
+        if (count > 2 * bytes.size())
+            return false;
+        for (uint32_t i = 0; i < count / 2; ++i)
+            if (bytes[i] != 0)
+                return false;
+        return count % 2 == 0 || (bytes[count / 2] >> 4) == 0;
+    }
+
+    std::string toHex() const {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(2 * bytes.size(), '0');
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            out[2 * i] = digits[bytes[i] >> 4];
+            out[2 * i + 1] = digits[bytes[i] & 0x0f];
+        }
+        return out;
+    }
+};
+static_assert(std::is_trivially_copyable<Hash256>::value, "Hash256 must stay trivially copyable");
+
+std::ostream& operator<<(std::ostream& os, const Hash256& h) {
+    return os << h.toHex();
+}
+
+// === Helper function: compute SHA256 digest ===
+Hash256 sha256(const std::string& data) {
+    Hash256 hash;
+    SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), hash.bytes.data());
+    return hash;
 }
 
+// === Helper function: append a little-endian 64-bit integer ===
+void appendLE64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i)
+        out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+// === Outcome of a parallel mining run ===
+struct MiningResult {
+    unsigned winningThread;  // Worker that found the valid nonce
+    unsigned threadCount;    // Workers that took part
+};
+
 // === Block structure ===
 struct Block {
     uint64_t index;
-    std::string previousHash;
+    Hash256 previousHash;
     std::string data;
     uint64_t timestamp;
     uint64_t nonce;
-    std::string hash;
+    Hash256 hash;
 
-    Block(uint64_t idx, const std::string& prev, const std::string& d)
+    Block(uint64_t idx, const Hash256& prev, const std::string& d)
         : index(idx), previousHash(prev), data(d), timestamp(std::time(nullptr)), nonce(0) {}
 
-    std::string computeHash(uint64_t testNonce) const {
-        std::ostringstream ss;
-        ss << index << previousHash << data << timestamp << testNonce;
-        return sha256_hex(ss.str());
+    // Hashes a binary preimage (index, raw previous hash, data, timestamp, nonce)
+    // so no hex string or stream is built per nonce attempt
+    Hash256 computeHash(uint64_t testNonce) const {
+        std::string preimage;
+        preimage.reserve(3 * sizeof(uint64_t) + previousHash.bytes.size() + data.size());
+        appendLE64(preimage, index);
+        preimage.append(reinterpret_cast<const char*>(previousHash.bytes.data()), previousHash.bytes.size());
+        preimage += data;
+        appendLE64(preimage, timestamp);
+        appendLE64(preimage, testNonce);
+        return sha256(preimage);
     }
 
-    // Mining (Proof of Work)
-    void mineBlock(uint32_t difficulty) {
-        std::string prefix(difficulty, '0');
-        while (true) {
-            hash = computeHash(nonce);
-            if (hash.substr(0, difficulty) == prefix)
-                break;
-            ++nonce;
+    // Mining (Proof of Work), split across worker threads
+    MiningResult mineBlock(uint32_t difficulty, unsigned numThreads = 0) {
+        if (numThreads == 0)
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+        // Each worker scans its own contiguous slice of the 64-bit nonce space;
+        // the first one to find a valid hash raises `found` and the rest stop.
+        const uint64_t sliceSize = std::numeric_limits<uint64_t>::max() / numThreads;
+        std::atomic<bool> found(false);
+        MiningResult result{0, numThreads};
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < numThreads; ++t) {
+            workers.emplace_back([&, t]() {
+                const uint64_t first = t * sliceSize;
+                const uint64_t last = (t + 1 == numThreads) ? std::numeric_limits<uint64_t>::max()
+                                                            : first + sliceSize - 1;
+                for (uint64_t n = first; !found.load(std::memory_order_relaxed); ++n) {
+                    Hash256 candidate = computeHash(n);
+                    if (candidate.hasLeadingZeroNibbles(difficulty)) {
+                        bool expected = false;
+                        if (found.compare_exchange_strong(expected, true)) {
+                            nonce = n;
+                            hash = candidate;
+                            result.winningThread = t;
+                        }
+                        return;
+                    }
+                    if (n == last)
+                        return;
+                }
+            });
         }
+        for (auto& w : workers)
+            w.join();
+        return result;
     }
 };
 
@@ -56,16 +143,16 @@ private:
 
 public:
     Blockchain(uint32_t diff) : difficulty(diff) {
-        chain.emplace_back(0, "0", "Genesis Block");
+        chain.emplace_back(0, Hash256{}, "Genesis Block");
         chain[0].mineBlock(difficulty);
     }
 
     void addBlock(const std::string& data) {
-        const std::string prevHash = chain.back().hash;
+        const Hash256 prevHash = chain.back().hash;
         Block newBlock(chain.size(), prevHash, data);
 
         auto start = std::chrono::high_resolution_clock::now();
-        newBlock.mineBlock(difficulty);
+        MiningResult mined = newBlock.mineBlock(difficulty);
         auto end = std::chrono::high_resolution_clock::now();
 
         long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
@@ -73,8 +160,9 @@ public:
         chain.push_back(newBlock);
 
         std::cout << "Block " << newBlock.index << " mined!" << std::endl;
-        std::cout << "Hash: " << newBlock.hash.substr(0, 40) << "..." << std::endl;
+        std::cout << "Hash: " << newBlock.hash.toHex().substr(0, 40) << "..." << std::endl;
         std::cout << "Nonce: " << newBlock.nonce << std::endl;
+        std::cout << "Found by thread " << mined.winningThread << " of " << mined.threadCount << std::endl;
         std::cout << "Time: " << elapsed << " ms" << std::endl << std::endl;
     }
 };
@@ -1,113 +1,392 @@
 // Exercice3.cpp: Proof of Stake Implementation with Comparison to Proof of Work
 
 #include <iostream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <chrono>
 #include <iomanip>
 #include <cstdint>
+#include <cstring>
+#include <array>
+#include <type_traits>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <algorithm>
 #include <random>  // For random selection in PoS
+#include <stdexcept>
 #include <openssl/sha.h>
 
-// === Helper function: compute SHA256 and return hex string ===
-std::string sha256_hex(const std::string& data) {
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), hash);
-    std::ostringstream oss;
-    oss << std::hex << std::setfill('0');
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i)
-        oss << std::setw(2) << static_cast<int>(hash[i]);
-    return oss.str();
+// === Hash256: fixed-size binary SHA256 digest ===
+// Hashes stay as raw 32-byte values; hex is only produced when printing.
+struct Hash256 {
+    std::array<uint8_t, SHA256_DIGEST_LENGTH> bytes{};
+
+    bool operator==(const Hash256& other) const {
+        return std::memcmp(bytes.data(), other.bytes.data(), bytes.size()) == 0;
+    }
+    bool operator!=(const Hash256& other) const { return !(*this == other); }
+    bool operator<(const Hash256& other) const {
+        return std::memcmp(bytes.data(), other.bytes.data(), bytes.size()) < 0;
+    }
+
+    std::string toHex() const {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(2 * bytes.size(), '0');
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            out[2 * i] = digits[bytes[i] >> 4];
+            out[2 * i + 1] = digits[bytes[i] & 0x0f];
+        }
+        return out;
+    }
+};
+static_assert(std::is_trivially_copyable<Hash256>::value, "Hash256 must stay trivially copyable");
+
+std::ostream& operator<<(std::ostream& os, const Hash256& h) {
+    return os << h.toHex();
+}
+
+// === Helper function: compute SHA256 digest ===
+Hash256 sha256(const std::string& data) {
+    Hash256 hash;
+    SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), hash.bytes.data());
+    return hash;
+}
+
+// === Helper function: append a little-endian 64-bit integer ===
+void appendLE64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i)
+        out.push_back(static_cast<char>(v >> (8 * i)));
 }
 
+// === 256-bit Proof of Work target ===
+// A hash is valid when, read as a big-endian 256-bit number, it is <= the
+// target. Lowering the target by any factor gives fine-grained difficulty,
+// unlike counting leading hex zeros (16x steps).
+struct Target256 {
+    std::array<uint8_t, SHA256_DIGEST_LENGTH> bytes{};  // Big-endian
+    uint32_t firstWord = 0;  // bytes[0..4) as an integer, for the early exit
+
+    // Decode Bitcoin-style compact "bits": 1-byte exponent, 3-byte mantissa,
+    // target = mantissa * 256^(exponent - 3). Negative mantissas give a zero target.
+    static Target256 fromCompact(uint32_t bits) {
+        Target256 target;
+        const int exponent = static_cast<int>(bits >> 24);
+        const uint32_t mantissa = (bits & 0x00800000) ? 0 : (bits & 0x007fffff);
+        for (int i = 0; i < 3; ++i) {
+            const int pos = static_cast<int>(target.bytes.size()) - exponent + i;
+            if (pos >= 0 && pos < static_cast<int>(target.bytes.size()))
+                target.bytes[pos] = static_cast<uint8_t>(mantissa >> (8 * (2 - i)));
+        }
+        target.updateFirstWord();
+        return target;
+    }
+
+    // Largest target whose top `zeroBits` bits are zero
+    static Target256 fromLeadingZeroBits(uint32_t zeroBits) {
+        Target256 target;
+        for (size_t i = 0; i < target.bytes.size(); ++i) {
+            const uint32_t bitPos = static_cast<uint32_t>(8 * i);
+            if (bitPos + 8 <= zeroBits)
+                target.bytes[i] = 0x00;
+            else if (bitPos >= zeroBits)
+                target.bytes[i] = 0xff;
+            else
+                target.bytes[i] = static_cast<uint8_t>(0xff >> (zeroBits - bitPos));
+        }
+        target.updateFirstWord();
+        return target;
+    }
+
+    // Compact encoding (keeps the 3 most significant bytes)
+    uint32_t toCompact() const {
+        size_t first = 0;
+        while (first < bytes.size() && bytes[first] == 0)
+            ++first;
+        uint32_t size = static_cast<uint32_t>(bytes.size() - first);
+        uint32_t mantissa = 0;
+        for (size_t i = 0; i < 3; ++i)
+            mantissa = (mantissa << 8) | (first + i < bytes.size() ? bytes[first + i] : 0);
+        if (mantissa & 0x00800000) {
+            mantissa >>= 8;
+            ++size;
+        }
+        return (size << 24) | mantissa;
+    }
+
+    bool isMetBy(const Hash256& hash) const {
+        const uint32_t word = loadBE32(hash.bytes.data());
+        if (word != firstWord)
+            return word < firstWord;
+        return std::memcmp(hash.bytes.data() + 4, bytes.data() + 4, bytes.size() - 4) <= 0;
+    }
+
+private:
+    static uint32_t loadBE32(const uint8_t* in) {
+        return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | uint32_t(in[3]);
+    }
+
+    void updateFirstWord() { firstWord = loadBE32(bytes.data()); }
+};
+
 // === Block structure (shared for PoW and PoS) ===
 struct Block {
     uint64_t index;
-    std::string previousHash;
+    Hash256 previousHash;
     std::string data;
     uint64_t timestamp;
     uint64_t nonce;  // Used in PoW; in PoS, can be validator ID or similar
-    std::string hash;
+    Hash256 hash;
 
-    Block(uint64_t idx, const std::string& prev, const std::string& d)
+    Block(uint64_t idx, const Hash256& prev, const std::string& d)
         : index(idx), previousHash(prev), data(d), timestamp(std::time(nullptr)), nonce(0) {}
 
-    std::string computeHash(uint64_t testNonce) const {
-        std::ostringstream ss;
-        ss << index << previousHash << data << timestamp << testNonce;
-        return sha256_hex(ss.str());
+    // Hashes a binary preimage (index, raw previous hash, data, timestamp, nonce)
+    // so no hex string or stream is built per nonce attempt
+    Hash256 computeHash(uint64_t testNonce) const {
+        std::string preimage;
+        preimage.reserve(3 * sizeof(uint64_t) + previousHash.bytes.size() + data.size());
+        appendLE64(preimage, index);
+        preimage.append(reinterpret_cast<const char*>(previousHash.bytes.data()), previousHash.bytes.size());
+        preimage += data;
+        appendLE64(preimage, timestamp);
+        appendLE64(preimage, testNonce);
+        return sha256(preimage);
     }
 };
 
+// === Outcome of a parallel mining run ===
+struct MiningResult {
+    unsigned winningThread;  // Worker that found the valid nonce
+    unsigned threadCount;    // Workers that took part
+};
+
 // === Proof of Work Blockchain ===
 class PoWBlockchain {
 private:
     std::vector<Block> chain;
-    uint32_t difficulty;
+    Target256 target;
 
 public:
-    PoWBlockchain(uint32_t diff) : difficulty(diff) {
-        chain.emplace_back(0, "0", "Genesis Block");
+    PoWBlockchain(const Target256& t) : target(t) {
+        chain.emplace_back(0, Hash256{}, "Genesis Block");
         mineBlock(chain.back());
     }
 
     void addBlock(const std::string& data) {
-        const std::string prevHash = chain.back().hash;
+        const Hash256 prevHash = chain.back().hash;
         Block newBlock(chain.size(), prevHash, data);
         mineBlock(newBlock);
         chain.push_back(newBlock);
     }
 
-    void mineBlock(Block& block) {
-        std::string prefix(difficulty, '0');
-        while (true) {
-            block.hash = block.computeHash(block.nonce);
-            if (block.hash.substr(0, difficulty) == prefix)
-                break;
-            ++block.nonce;
+    // Mine with the nonce space split into one contiguous slice per thread;
+    // the first worker to find a valid hash stops the others.
+    MiningResult mineBlock(Block& block, unsigned numThreads = 0) {
+        if (numThreads == 0)
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+        const uint64_t sliceSize = std::numeric_limits<uint64_t>::max() / numThreads;
+        std::atomic<bool> found(false);
+        MiningResult result{0, numThreads};
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < numThreads; ++t) {
+            workers.emplace_back([&, t]() {
+                const uint64_t first = t * sliceSize;
+                const uint64_t last = (t + 1 == numThreads) ? std::numeric_limits<uint64_t>::max()
+                                                            : first + sliceSize - 1;
+                for (uint64_t n = first; !found.load(std::memory_order_relaxed); ++n) {
+                    Hash256 candidate = block.computeHash(n);
+                    if (target.isMetBy(candidate)) {
+                        bool expected = false;
+                        if (found.compare_exchange_strong(expected, true)) {
+                            block.nonce = n;
+                            block.hash = candidate;
+                            result.winningThread = t;
+                        }
+                        return;
+                    }
+                    if (n == last)
+                        return;
+                }
+            });
         }
+        for (auto& w : workers)
+            w.join();
+        return result;
     }
 
     size_t size() const { return chain.size(); }
 };
 
+// === xoshiro256** PRNG ===
+// Small, fast generator with no syscalls: 4 words of state, a few shifts and
+// rotates per draw. A given seed yields the same sequence on every platform,
+// so proposer selection can be replayed. Usable with <random> as a
+// UniformRandomBitGenerator.
+class Xoshiro256StarStar {
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256StarStar(uint64_t seed = 0) { reseed(seed); }
+    explicit Xoshiro256StarStar(const Hash256& seed) { reseed(seed); }
+
+    // Expand a 64-bit seed with splitmix64 (never yields the all-zero state)
+    void reseed(uint64_t seed) {
+        for (auto& word : state) {
+            word = splitMix64(seed);
+        }
+    }
+
+    // Seed from a block hash: each 64-bit word is mixed into one state word
+    void reseed(const Hash256& seed) {
+        for (size_t i = 0; i < 4; ++i) {
+            uint64_t word = 0;
+            for (size_t b = 0; b < 8; ++b) {
+                word |= uint64_t(seed.bytes[8 * i + b]) << (8 * b);
+            }
+            state[i] = splitMix64(word);
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+        const uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+private:
+    uint64_t state[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    static uint64_t splitMix64(uint64_t& x) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+};
+
+// === Alias table for O(1) stake-weighted selection ===
+// Vose's alias method: every validator gets a column holding its own
+// probability and an "alias" that takes the rest of the column. Building is
+// O(n) and is redone only when stakes change; each draw is then one column
+// pick and one biased coin flip, whatever the number of validators.
+class StakeAliasTable {
+public:
+    StakeAliasTable() = default;
+
+    explicit StakeAliasTable(const std::vector<uint64_t>& stakes) : probability(stakes.size()), alias(stakes.size()) {
+        // Plain doubles throughout: IEEE arithmetic gives every node the same table
+        double totalStake = 0;
+        for (uint64_t stake : stakes) {
+            totalStake += static_cast<double>(stake);
+        }
+        if (totalStake <= 0) {
+            throw std::invalid_argument("StakeAliasTable: total stake must be positive");
+        }
+
+        // Scale so the average column is 1, then pair each short column with a tall one
+        const size_t n = stakes.size();
+        std::vector<double> scaled(n);
+        std::vector<uint32_t> small, large;
+        for (size_t i = 0; i < n; ++i) {
+            scaled[i] = static_cast<double>(stakes[i]) * static_cast<double>(n) / totalStake;
+            (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+        }
+        while (!small.empty() && !large.empty()) {
+            const uint32_t s = small.back(), l = large.back();
+            small.pop_back();
+            large.pop_back();
+            probability[s] = scaled[s];
+            alias[s] = l;
+            scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+            (scaled[l] < 1.0 ? small : large).push_back(l);
+        }
+        // Leftovers are full columns (up to rounding)
+        for (uint32_t i : large) {
+            probability[i] = 1.0;
+            alias[i] = i;
+        }
+        for (uint32_t i : small) {
+            probability[i] = 1.0;
+            alias[i] = i;
+        }
+    }
+
+    // Index drawn with probability proportional to its stake. Maps raw 64-bit
+    // draws itself: <random> distributions differ between standard libraries.
+    template <typename Rng>
+    size_t sample(Rng& gen) const {
+        static_assert(Rng::min() == 0 && Rng::max() == UINT64_MAX, "sample needs a 64-bit generator");
+        const size_t i = static_cast<size_t>(gen() % probability.size());
+        const double coin = static_cast<double>(gen() >> 11) * 0x1.0p-53; // Uniform in [0, 1)
+        return coin < probability[i] ? i : alias[i];
+    }
+
+    size_t size() const { return probability.size(); }
+
+private:
+    std::vector<double> probability;
+    std::vector<uint32_t> alias;
+};
+
+// Where the randomness behind each proposer draw comes from
+enum class ProposerSeed {
+    Local,        // One stream per node from the constructor seed: reproducible runs
+    PreviousHash, // Reseeded from the previous block hash: every node picks the same proposer
+};
+
 // === Proof of Stake Blockchain ===
 class PoSBlockchain {
 private:
     std::vector<Block> chain;
     std::vector<std::pair<std::string, uint64_t>> validators;  // Validator name and stake
 
-    // Select validator based on stake (weighted random)
-    std::string selectValidator() {
-        uint64_t totalStake = 0;
-        for (const auto& v : validators) {
-            totalStake += v.second;
-        }
+    StakeAliasTable selection;  // Rebuilt whenever stakes change
+    ProposerSeed seeding;
+    Xoshiro256StarStar rng;
 
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<uint64_t> dis(0, totalStake - 1);
+    // Select validator based on stake (weighted random), O(1) per block
+    std::string selectValidator(const Hash256& previousHash) {
+        if (seeding == ProposerSeed::PreviousHash) {
+            rng.reseed(previousHash);
+        }
+        return validators[selection.sample(rng)].first;
+    }
 
-        uint64_t rand = dis(gen);
-        uint64_t current = 0;
+    void rebuildSelection() {
+        std::vector<uint64_t> stakes;
+        stakes.reserve(validators.size());
         for (const auto& v : validators) {
-            current += v.second;
-            if (rand < current) {
-                return v.first;
-            }
+            stakes.push_back(v.second);
         }
-        return validators.back().first;  // Fallback
+        selection = StakeAliasTable(stakes);
     }
 
 public:
-    PoSBlockchain(const std::vector<std::pair<std::string, uint64_t>>& vals) : validators(vals) {
-        chain.emplace_back(0, "0", "Genesis Block");
+    // `seed` drives ProposerSeed::Local; the default draws it once from the OS
+    PoSBlockchain(const std::vector<std::pair<std::string, uint64_t>>& vals,
+                  ProposerSeed seedMode = ProposerSeed::Local, uint64_t seed = std::random_device{}())
+        : validators(vals), seeding(seedMode), rng(seed) {
+        rebuildSelection();
+        chain.emplace_back(0, Hash256{}, "Genesis Block");
         forgeBlock(chain.back());
     }
 
     void addBlock(const std::string& data) {
-        const std::string prevHash = chain.back().hash;
+        const Hash256 prevHash = chain.back().hash;
         Block newBlock(chain.size(), prevHash, data);
         forgeBlock(newBlock);
         chain.push_back(newBlock);
@@ -115,7 +394,7 @@ public:
 
     void forgeBlock(Block& block) {
         // In PoS, "forging" is quick: select validator and compute hash once
-        std::string validator = selectValidator();
+        std::string validator = selectValidator(block.previousHash);
         block.nonce = 0;  // Nonce not used for puzzle, could store validator ID
         block.data += " (Forged by: " + validator + ")";  // Simulate validator signature
         block.hash = block.computeHash(block.nonce);
@@ -143,7 +422,8 @@ int main() {
 
         // === Proof of Work Timing ===
         auto powStart = std::chrono::high_resolution_clock::now();
-        PoWBlockchain powBC(diff);
+        // Difficulty N means N leading zero hex digits, i.e. 4N zero bits
+        PoWBlockchain powBC(Target256::fromLeadingZeroBits(4 * diff));
         for (int i = 1; i <= numBlocks; ++i) {
             powBC.addBlock("Transaction " + std::to_string(i));
             std::cout << "PoW Block " << powBC.size() - 1 << " added." << std::endl;
@@ -170,5 +450,49 @@ int main() {
                   << std::abs(powTime - posTime) << " ms." << std::endl << std::endl;
     }
 
+    // === Validator selection benchmark ===
+    // Linear scan (the old selectValidator) vs alias table draws
+    std::cout << "Validator selection benchmark:" << std::endl;
+    Xoshiro256StarStar benchGen(42);
+    for (size_t count : {size_t(10000), size_t(1000000)}) {
+        std::vector<uint64_t> stakes(count);
+        std::uniform_int_distribution<uint64_t> stakeDis(1, 1000000);
+        uint64_t totalStake = 0;
+        for (auto& stake : stakes) {
+            stake = stakeDis(benchGen);
+            totalStake += stake;
+        }
+
+        const int linearDraws = 1000, aliasDraws = 1000000;
+        size_t checksum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        std::uniform_int_distribution<uint64_t> dis(0, totalStake - 1);
+        for (int d = 0; d < linearDraws; ++d) {
+            uint64_t rand = dis(benchGen), current = 0;
+            size_t i = 0;
+            while (rand >= (current += stakes[i])) {
+                ++i;
+            }
+            checksum += i;
+        }
+        auto linearEnd = std::chrono::high_resolution_clock::now();
+        StakeAliasTable table(stakes);
+        auto buildEnd = std::chrono::high_resolution_clock::now();
+        for (int d = 0; d < aliasDraws; ++d) {
+            checksum += table.sample(benchGen);
+        }
+        auto aliasEnd = std::chrono::high_resolution_clock::now();
+
+        auto nsPerDraw = [](std::chrono::high_resolution_clock::duration elapsed, int draws) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / draws;
+        };
+        std::cout << "  " << count << " validators: linear scan " << nsPerDraw(linearEnd - start, linearDraws)
+                  << " ns/draw, alias table " << nsPerDraw(aliasEnd - buildEnd, aliasDraws) << " ns/draw (built in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(buildEnd - linearEnd).count() << " ms)"
+                  << std::endl;
+        volatile size_t sink = checksum;  // Keep the draws from being optimized out
+        (void)sink;
+    }
+
     return 0;
 }
\ No newline at end of file